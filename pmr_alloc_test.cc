@@ -0,0 +1,261 @@
+#include "program_options.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// every global operator new aborts, so the test fails on any allocation that
+// does not come from the parser's memory resource
+namespace {
+[[noreturn]] void global_new_called() {
+    std::fputs("unexpected global operator new\n", stderr);
+    std::abort();
+}
+}  // namespace
+
+void* operator new(std::size_t) { global_new_called(); }
+void* operator new[](std::size_t) { global_new_called(); }
+void* operator new(std::size_t, const std::nothrow_t&) noexcept {
+    global_new_called();
+}
+void* operator new[](std::size_t, const std::nothrow_t&) noexcept {
+    global_new_called();
+}
+void* operator new(std::size_t, std::align_val_t) { global_new_called(); }
+void* operator new[](std::size_t, std::align_val_t) { global_new_called(); }
+void* operator new(std::size_t, std::align_val_t,
+                   const std::nothrow_t&) noexcept {
+    global_new_called();
+}
+void* operator new[](std::size_t, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+    global_new_called();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, \
+                         __LINE__, #cond);                              \
+            std::abort();                                               \
+        }                                                               \
+    } while (false)
+
+namespace PO = program_options;
+
+namespace {
+// stateful and not default-constructible, so any allocation that does not
+// come from the parser's allocator fails to compile or hits operator new
+template <typename T>
+class arena_allocator {
+   public:
+    using value_type = T;
+
+    explicit arena_allocator(std::pmr::memory_resource* resource)
+        : resource_(resource) {}
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other)
+        : resource_(other.resource()) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(
+            resource_->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, std::size_t n) {
+        resource_->deallocate(p, n * sizeof(T), alignof(T));
+    }
+    std::pmr::memory_resource* resource() const { return resource_; }
+
+   private:
+    std::pmr::memory_resource* resource_;
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) {
+    return lhs.resource() == rhs.resource();
+}
+
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) {
+    return !(lhs == rhs);
+}
+
+bool contains(const PO::pmr::parser::string_type& str, const char* part) {
+    return str.find(part) != PO::pmr::parser::string_type::npos;
+}
+
+void define(PO::pmr::parser& parser) {
+    auto alloc = parser.get_allocator();
+    parser
+        .add<std::pmr::string>("host", 'h', "host name of the remote endpoint",
+                               true, "")
+        .add<int>("port", 'p', "port number to connect to", false, 80,
+                  PO::range(1, 65535))
+        .add<std::pmr::string>(
+            "type", 't', "protocol type used for the transfer", false,
+            std::pmr::string("https-over-a-long-tunnel", alloc),
+            PO::oneof<std::pmr::string>(std::allocator_arg, alloc,
+                                        "http", "https-over-a-long-tunnel",
+                                        "secure-shell-protocol", "ftp"))
+        .add<double>("ratio", 'r', "compression ratio of the payload", false,
+                     0.5, PO::range(0.0, 1.0))
+        .add("gzip", 'z', "gzip the payload when transferring it");
+    parser.set_footer("filename ... and a footer longer than the small buffer");
+    parser.set_program_name("pmr_alloc_test_with_a_long_program_name");
+}
+
+void parse_success(PO::pmr::parser& parser) {
+    const char* argv[] = {"pmr_alloc_test",
+                          "--host=a-very-long-host-name.example.com",
+                          "-p",
+                          "8080",
+                          "--type=secure-shell-protocol",
+                          "-zr",
+                          "0.25",
+                          "some-long-positional-argument-value"};
+    CHECK(parser.parse(sizeof(argv) / sizeof(argv[0]), argv));
+    CHECK(parser.get<std::pmr::string>("host") ==
+          "a-very-long-host-name.example.com");
+    CHECK(parser.get<int>("port") == 8080);
+    CHECK(parser.get<std::pmr::string>("type") == "secure-shell-protocol");
+    CHECK(parser.get<double>("ratio") == 0.25);
+    CHECK(parser.exist("gzip"));
+    CHECK(parser.rest().size() == 1);
+    CHECK(parser.rest()[0] == "some-long-positional-argument-value");
+    CHECK(parser.error().empty());
+    CHECK(parser.all_errors().empty());
+
+    auto usage = parser.usage();
+    CHECK(contains(usage, "pmr_alloc_test_with_a_long_program_name"));
+    CHECK(contains(usage, "--host=String"));
+    CHECK(contains(usage, "(Integral [=80])"));
+    CHECK(contains(usage, "[=\"https-over-a-long-tunnel\"]"));
+    CHECK(contains(usage, "(FloatingPoint [=0.5])"));
+
+    CHECK(parser.parse("pmr_alloc_test --host=\"another long host name\" "
+                       "--ratio=1e-1 trailing\\ positional\\ argument"));
+    CHECK(parser.get<std::pmr::string>("host") == "another long host name");
+    CHECK(parser.get<double>("ratio") == 0.1);
+    CHECK(parser.rest()[0] == "trailing positional argument");
+}
+
+class even_reader {
+   public:
+    int operator()(const PO::pmr::parser::string_type& str) const {
+        int ret{PO::default_reader<int>()(str)};
+        if (ret % 2)
+            throw PO::program_options_error(
+                "value rejected by the even number reader");
+        return ret;
+    }
+};
+
+void parse_errors(PO::pmr::parser& parser) {
+    const char* argv[] = {"pmr_alloc_test",
+                          "--port=99999",
+                          "--type=gopher-protocol",
+                          "--ratio=nan",
+                          "--ratio=0x10",
+                          "--an-undefined-long-option",
+                          "--even=3",
+                          "-q"};
+    PO::pmr::parser fresh{parser.get_allocator()};
+    define(fresh);
+    fresh.add<int>("even", 'e', "an even number", false, 0, even_reader());
+    CHECK(!fresh.parse(sizeof(argv) / sizeof(argv[0]), argv));
+    CHECK(contains(fresh.error(), "--port=99999"));
+
+    auto errors = fresh.all_errors();
+    CHECK(contains(errors, "option value is invalid: --port=99999"));
+    CHECK(contains(errors, "option value is invalid: --type=gopher-protocol"));
+    CHECK(contains(errors, "option value is invalid: --ratio=nan"));
+    CHECK(contains(errors, "option value is invalid: --ratio=0x10"));
+    CHECK(contains(errors, "undefined option: --an-undefined-long-option"));
+    CHECK(contains(errors, "undefined short option: -q"));
+    CHECK(contains(errors, "option value is invalid: --even=3"));
+    CHECK(contains(errors, "need option: --host"));
+    CHECK(contains(fresh.usage(), "gzip the payload when transferring it"));
+
+    CHECK(!parser.parse("pmr_alloc_test --host=\"unterminated quote"));
+    CHECK(contains(parser.all_errors(), "quote is not closed"));
+}
+void repeated_lookups() {
+    alignas(std::max_align_t) static char storage[4 * 1024];
+    std::pmr::monotonic_buffer_resource arena(storage, sizeof(storage),
+                                              std::pmr::null_memory_resource());
+    PO::pmr::parser parser(&arena);
+    parser.add<int>("connection-timeout-ms", 'c', "", false, 30000)
+        .add("verbose-diagnostics-enabled", 'v');
+    const char* argv[] = {"pmr_alloc_test", "--connection-timeout-ms=250"};
+    CHECK(parser.parse(2, argv));
+    for (int i = 0; i != 100000; ++i) {
+        CHECK(parser.get<int>("connection-timeout-ms") == 250);
+        CHECK(!parser.exist("verbose-diagnostics-enabled"));
+    }
+}
+void custom_allocator() {
+    alignas(std::max_align_t) static char storage[16 * 1024];
+    std::pmr::monotonic_buffer_resource arena(storage, sizeof(storage),
+                                              std::pmr::null_memory_resource());
+    using parser_t = PO::basic_parser<arena_allocator<char>>;
+    using string_t = parser_t::string_type;
+    parser_t parser{arena_allocator<char>(&arena)};
+    auto alloc = parser.get_allocator();
+    parser
+        .add<string_t>("mode-of-operation", 'm', "", false,
+                       string_t("synchronous-replication", alloc),
+                       PO::oneof<string_t>(std::allocator_arg, alloc,
+                                           "synchronous-replication",
+                                           "asynchronous-replication"))
+        .add("verbose-diagnostics-enabled", 'v');
+    const char* argv[] = {"pmr_alloc_test", "-vm", "asynchronous-replication",
+                          "another-long-positional-argument"};
+    CHECK(parser.parse(sizeof(argv) / sizeof(argv[0]), argv));
+    CHECK(parser.get<string_t>("mode-of-operation") ==
+          "asynchronous-replication");
+    CHECK(parser.exist("verbose-diagnostics-enabled"));
+    CHECK(parser.rest()[0].get_allocator() == alloc);
+
+    const char* bad[] = {"pmr_alloc_test", "--mode-of-operation=eventual"};
+    CHECK(!parser.parse(2, bad));
+    CHECK(parser.all_errors().find("--mode-of-operation=eventual") !=
+          string_t::npos);
+}
+}  // namespace
+
+int main() {
+    std::pmr::set_default_resource(std::pmr::null_memory_resource());
+
+    alignas(std::max_align_t) static char storage[64 * 1024];
+    std::pmr::monotonic_buffer_resource arena(storage, sizeof(storage),
+                                              std::pmr::null_memory_resource());
+    {
+        PO::pmr::parser parser(&arena);
+        define(parser);
+        parse_success(parser);
+
+        PO::pmr::parser copy(parser);
+        CHECK(copy.get<int>("port") == 8080);
+        CHECK(copy.rest().get_allocator().resource() == &arena);
+
+        parse_errors(parser);
+    }
+    repeated_lookups();
+    custom_allocator();
+    std::puts("OK");
+    return 0;
+}
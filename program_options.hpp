@@ -1,11 +1,18 @@
 #pragma once
 
 #include <algorithm>
+#include <cerrno>
+#include <clocale>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iostream>
+#include <locale>
 #include <memory>
-#include <sstream>
+#include <streambuf>
 #include <string>
 #include <type_traits>
 #include <typeinfo>
@@ -14,76 +21,181 @@
 #include <utility>
 #include <vector>
 
+#if defined(_MSC_VER) || defined(__GLIBC__)
+#include <locale.h>
+#define PROGRAM_OPTIONS_HAS_STRTOD_L 1
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+#include <locale.h>
+#include <xlocale.h>
+#define PROGRAM_OPTIONS_HAS_STRTOD_L 1
+#endif
+
+#if defined(__has_include)
+#if __has_include(<memory_resource>) && \
+    (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <memory_resource>
+#define PROGRAM_OPTIONS_HAS_PMR 1
+#endif
+#endif
+
 namespace program_options {
 using string_t = std::string;
 
 namespace detail {
-template <typename Target, typename Source, bool IsSame>
-class lexical_cast_t {
-   public:
-    static Target cast(Source&& arg) {
-        Target ret;
-        std::stringstream ss;
-        if (!(ss << std::forward<Source>(arg) && ss >> ret && ss.eof()))
-            throw std::bad_cast();
-        return ret;
-    }
-};
+template <typename T>
+struct is_basic_string : std::false_type {};
+
+template <typename Allocator>
+struct is_basic_string<
+    std::basic_string<char, std::char_traits<char>, Allocator>>
+    : std::true_type {};
+
+template <typename T>
+struct is_string : is_basic_string<typename std::remove_cv<T>::type> {};
+
+template <typename T>
+constexpr bool is_string_v = is_string<T>::value;
 
-template <typename Target, typename Source>
-class lexical_cast_t<Target, Source, true> {
+// non-owning view of the characters of a c-string or any basic_string, so
+// names and descriptions can be passed in without building a temporary
+// string on the global heap
+class string_ref {
    public:
-    static Target cast(Source&& arg) { return std::forward<Source>(arg); }
+    string_ref(const char* str) : data_(str), size_(std::strlen(str)) {}
+    template <typename Allocator>
+    string_ref(
+        const std::basic_string<char, std::char_traits<char>, Allocator>& str)
+        : data_(str.data()), size_(str.size()) {}
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    char operator[](std::size_t i) const { return data_[i]; }
+
+   private:
+    const char* data_;
+    std::size_t size_;
 };
 
-template <typename Target>
-class lexical_cast_t<Target, string_t, false> {
+inline bool equal(string_ref lhs, string_ref rhs) {
+    return lhs.size() == rhs.size() &&
+           std::char_traits<char>::compare(lhs.data(), rhs.data(),
+                                           lhs.size()) == 0;
+}
+
+// reads from a character range in place
+class input_buffer : public std::streambuf {
    public:
-    static Target cast(string_t&& arg) {
-        Target ret;
-        std::istringstream ss(arg);
-        if (!(ss >> ret && ss.eof())) throw std::bad_cast();
-        return ret;
+    input_buffer(const char* first, const char* last) {
+        char* begin{const_cast<char*>(first)};
+        setg(begin, begin, const_cast<char*>(last));
     }
 };
 
-template <typename Source>
-class lexical_cast_t<string_t, Source, false> {
+// writes straight into a string, which keeps its own allocator
+template <typename String>
+class output_buffer : public std::streambuf {
    public:
-    static string_t cast(Source&& arg) {
-        std::ostringstream ss;
-        if (!(ss << std::forward<Source>(arg))) throw std::bad_cast();
-        return ss.str();
+    explicit output_buffer(String& str) : str_(str) {}
+
+   protected:
+    int_type overflow(int_type ch) override {
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            str_.push_back(traits_type::to_char_type(ch));
+        return traits_type::not_eof(ch);
     }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        str_.append(s, static_cast<typename String::size_type>(n));
+        return n;
+    }
+
+   private:
+    String& str_;
 };
 
-template <typename Target, typename Source>
-constexpr bool is_same_v = std::is_same<Target, Source>::value;
+template <typename String>
+void append_one(String& str, string_ref part) {
+    str.append(part.data(), part.size());
+}
 
-template <typename Target, typename Source>
-Target lexical_cast(Source&& arg) {
-    return lexical_cast_t<Target, Source, is_same_v<Target, Source>>::cast(
-        std::forward<Source>(arg));
-};
+template <typename String>
+void append_one(String& str, char part) {
+    str.push_back(part);
+}
 
-template <typename T>
-struct is_string
-    : std::integral_constant<
-          bool, is_same_v<string_t, typename std::remove_cv<T>::type>> {};
+template <typename String, typename... Parts>
+void append(String& str, const Parts&... parts) {
+    using expand = int[];
+    (void)expand{0, (append_one(str, parts), 0)...};
+}
 
-template <typename T>
-constexpr bool is_string_v = is_string<T>::value;
+template <typename String, typename... Parts>
+String concat(String str, const Parts&... parts) {
+    append(str, parts...);
+    return str;
+}
 
-template <typename T>
-string_t as_string(T&& arg) {
-    string_t str{lexical_cast<string_t>(std::forward<T>(arg))};
-    if (is_string_v<std::remove_reference_t<T>>) {
-        return "\"" + str + "\"";
-    } else {
-        return str;
-    }
+template <typename Target, typename String>
+Target copy_string(const String& arg, std::true_type) {
+    return Target(arg.data(), arg.size(),
+                  typename Target::allocator_type(arg.get_allocator()));
+}
+
+template <typename Target, typename String>
+Target copy_string(const String& arg, std::false_type) {
+    return Target(arg.data(), arg.size());
+}
+
+template <typename String, typename T>
+void append_as_string(String& str, const T& arg, std::true_type) {
+    append(str, '\"', arg, '\"');
+}
+
+template <typename String, typename T>
+void append_as_string(String& str, const T& arg, std::false_type) {
+    output_buffer<String> buf(str);
+    std::ostream os(&buf);
+    if (!(os << arg)) throw std::bad_cast();
+}
+
+template <typename String, typename T>
+void append_as_string(String& str, const T& arg) {
+    append_as_string(str, arg, is_string<T>());
+}
+
+template <typename T, typename U, typename Allocator>
+T make_value(U&& value, const Allocator& alloc, std::true_type) {
+    return T(std::forward<U>(value), alloc);
+}
+
+template <typename T, typename U, typename Allocator>
+T make_value(U&& value, const Allocator&, std::false_type) {
+    return T(std::forward<U>(value));
+}
+
+// builds a T from value in storage obtained from alloc when T is
+// allocator-aware
+template <typename T, typename U, typename Allocator>
+T make_value(U&& value, const Allocator& alloc) {
+    return make_value<T>(std::forward<U>(value), alloc,
+                         std::uses_allocator<T, Allocator>());
 }
 
+struct string_hash {
+    template <typename String>
+    std::size_t operator()(const String& str) const {
+        std::uint64_t hash{14695981039346656037ull};
+        for (char ch : str) {
+            hash ^= static_cast<unsigned char>(ch);
+            hash *= 1099511628211ull;
+        }
+        return static_cast<std::size_t>(hash);
+    }
+};
+
+template <typename T>
+using hasher_t =
+    typename std::conditional<is_string_v<T>, string_hash, std::hash<T>>::type;
+
 template <typename T>
 constexpr bool is_integral_v = std::is_integral<T>::value;
 
@@ -119,41 +231,183 @@ struct type_name_impl<T, false, false, true> {
     static constexpr auto value = type_category::String;
 };
 
-#ifdef _MSC_VER
-using type_category_t = enum class type_category;
+template <typename T>
+constexpr type_category category_v =
+    type_name_impl<T, is_integral_v<T>, is_floating_point_v<T>,
+                   is_string_v<T>>::value;
+
+template <typename T>
+const char* type_name() {
+    static constexpr const char* names[] = {"IllegalType", "Integral",
+                                            "FloatingPoint", "String"};
+    return names[static_cast<int>(category_v<T>)];
+};
+
+template <typename Target, type_category Category>
+class lexical_cast_t {
+   public:
+    template <typename String>
+    static Target cast(const String& arg) {
+        Target ret;
+        input_buffer buf(arg.data(), arg.data() + arg.size());
+        std::istream is(&buf);
+        if (!(is >> ret && is.eof())) throw std::bad_cast();
+        return ret;
+    }
+};
+
+#if defined(_MSC_VER)
+inline _locale_t c_locale() {
+    static _locale_t locale{_create_locale(LC_NUMERIC, "C")};
+    return locale;
+}
+
+inline void strto(const char* str, char** end, float& ret) {
+    ret = _strtof_l(str, end, c_locale());
+}
+
+inline void strto(const char* str, char** end, double& ret) {
+    ret = _strtod_l(str, end, c_locale());
+}
+
+inline void strto(const char* str, char** end, long double& ret) {
+    ret = _strtold_l(str, end, c_locale());
+}
+#elif defined(PROGRAM_OPTIONS_HAS_STRTOD_L)
+inline locale_t c_locale() {
+    static locale_t locale{newlocale(LC_NUMERIC_MASK, "C", locale_t(0))};
+    return locale;
+}
+
+inline void strto(const char* str, char** end, float& ret) {
+    ret = strtof_l(str, end, c_locale());
+}
+
+inline void strto(const char* str, char** end, double& ret) {
+    ret = strtod_l(str, end, c_locale());
+}
+
+inline void strto(const char* str, char** end, long double& ret) {
+    ret = strtold_l(str, end, c_locale());
+}
+#endif
+
+#ifdef PROGRAM_OPTIONS_HAS_STRTOD_L
+inline bool is_digit(char ch) { return ch >= '0' && ch <= '9'; }
+
+inline bool is_space(char ch) {
+    return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+inline const char* skip_digits(const char* first, const char* last) {
+    while (first != last && is_digit(*first)) ++first;
+    return first;
+}
+
+// accepts what num_get reads as a floating point number: leading blanks, an
+// optional sign, decimal digits with an optional point and exponent; strtod
+// would also take inf, nan and hex floats
+inline bool is_decimal(const char* first, const char* last) {
+    while (first != last && is_space(*first)) ++first;
+    if (first != last && (*first == '+' || *first == '-')) ++first;
+    const char* integer_end{skip_digits(first, last)};
+    bool has_digits{integer_end != first};
+    first = integer_end;
+    if (first != last && *first == '.') {
+        const char* fraction_end{skip_digits(++first, last)};
+        has_digits = has_digits || fraction_end != first;
+        first = fraction_end;
+    }
+    if (!has_digits) return false;
+    if (first != last && (*first == 'e' || *first == 'E')) {
+        if (++first != last && (*first == '+' || *first == '-')) ++first;
+        const char* exponent_end{skip_digits(first, last)};
+        if (exponent_end == first) return false;
+        first = exponent_end;
+    }
+    return first == last;
+}
+
+// num_get buffers floating point digits in a std::string on the global heap,
+// so these are converted with strtod and friends under the "C" locale
+// instead; like num_get, only overflow is a range error
+template <typename Target>
+class lexical_cast_t<Target, type_category::FloatingPoint> {
+   public:
+    template <typename String>
+    static Target cast(const String& arg) {
+        if (!is_decimal(arg.data(), arg.data() + arg.size()))
+            throw std::bad_cast();
+        Target ret;
+        char* end{nullptr};
+        errno = 0;
+        strto(arg.c_str(), &end, ret);
+        if (end != arg.c_str() + arg.size() ||
+            (errno == ERANGE && std::isinf(ret)))
+            throw std::bad_cast();
+        return ret;
+    }
+};
 #else
-using type_category_t = enum type_category;
+// without a locale-taking strtod, read through num_get on the classic locale
+// as before; its digit buffer then comes from the global heap
+template <typename Target>
+class lexical_cast_t<Target, type_category::FloatingPoint> {
+   public:
+    template <typename String>
+    static Target cast(const String& arg) {
+        Target ret;
+        input_buffer buf(arg.data(), arg.data() + arg.size());
+        std::istream is(&buf);
+        is.imbue(std::locale::classic());
+        if (!(is >> ret && is.eof())) throw std::bad_cast();
+        return ret;
+    }
+};
 #endif
 
-template <typename T>
-string_t type_name() {
-    static std::unordered_map<type_category_t, string_t> names {
-        std::make_pair(type_category::IllegalType, "IllegalType"),
-        std::make_pair(type_category::Integral, "Integral"),
-        std::make_pair(type_category::FloatingPoint, "FloatingPoint"),
-        std::make_pair(type_category::String, "String")
-    };
-    auto category = type_name_impl<T, is_integral_v<T>, is_floating_point_v<T>,
-                                   is_string_v<T>>::value;
-    return names[category];
+template <typename Target>
+class lexical_cast_t<Target, type_category::String> {
+   public:
+    template <typename String>
+    static Target cast(const String& arg) {
+        return copy_string<Target>(
+            arg, std::is_constructible<typename Target::allocator_type,
+                                       typename String::allocator_type>());
+    }
+};
+
+template <typename Target, typename String>
+Target lexical_cast(const String& arg) {
+    return lexical_cast_t<Target, category_v<Target>>::cast(arg);
 };
 
 }  // namespace detail
 
+// may outlive a parser's allocator, so a message naming an option is built
+// on the global heap; a string literal, as the readers throw while parsing,
+// is kept by pointer and allocates nothing
 class program_options_error : public std::exception {
    public:
     template <typename T>
-    program_options_error(T&& msg) : msg_(std::forward<T>(msg)) {}
-    const char* what() const noexcept { return msg_.c_str(); }
+    program_options_error(T&& msg)
+        : msg_(std::forward<T>(msg)), literal_(nullptr) {}
+    template <std::size_t N>
+    program_options_error(const char (&msg)[N]) : literal_(msg) {}
+    const char* what() const noexcept {
+        return literal_ ? literal_ : msg_.c_str();
+    }
 
    private:
     string_t msg_;
+    const char* literal_;
 };
 
 template <typename T>
 class default_reader {
    public:
-    T operator()(const string_t& str) const {
+    template <typename String>
+    T operator()(const String& str) const {
         return detail::lexical_cast<T>(str);
     }
 };
@@ -163,9 +417,10 @@ class range_reader {
    public:
     range_reader(T&& begin, T&& end)
         : begin_(std::forward<T>(begin)), end_(std::forward<T>(end)) {}
-    T operator()(const string_t& str) const {
+    template <typename String>
+    T operator()(const String& str) const {
         T ret{default_reader<T>()(str)};
-        if (ret > end_ || ret < begin_)
+        if (!(ret >= begin_ && ret <= end_))
             throw program_options_error("range error");
         return ret;
     }
@@ -179,25 +434,34 @@ range_reader<T> range(T&& begin, T&& end) {
     return range_reader<T>(std::forward<T>(begin), std::forward<T>(end));
 }
 
-template <typename T>
+template <typename T, typename Allocator = std::allocator<T>>
 class oneof_reader {
    public:
-    T operator()(const string_t& str) {
+    oneof_reader() = default;
+    explicit oneof_reader(const Allocator& alloc) : allowed_(alloc) {}
+
+    template <typename String>
+    T operator()(const String& str) {
         T ret{default_reader<T>()(str)};
         if (allowed_.find(ret) == allowed_.end())
             throw program_options_error("oneof error");
         return ret;
     }
 
-    void add(T&& val) { allowed_.insert(std::forward<T>(val)); }
-    template <typename... U>
-    void add(T&& val, U&&... vals) {
-        allowed_.insert(std::forward<T>(val));
-        add(std::forward<U>(vals)...);
+    template <typename U>
+    void add(U&& val) {
+        allowed_.insert(detail::make_value<T>(std::forward<U>(val),
+                                              allowed_.get_allocator()));
+    }
+    template <typename U, typename... V>
+    void add(U&& val, V&&... vals) {
+        add(std::forward<U>(val));
+        add(std::forward<V>(vals)...);
     }
 
    private:
-    std::unordered_set<T> allowed_;
+    std::unordered_set<T, detail::hasher_t<T>, std::equal_to<T>, Allocator>
+        allowed_;
 };
 
 template <typename T, typename... U>
@@ -207,77 +471,145 @@ oneof_reader<T> oneof(U&&... vals) {
     return ret;
 }
 
-class parser {
+// allowed values are stored with alloc, e.g. oneof<std::pmr::string>(
+// std::allocator_arg, parser.get_allocator(), "http", "https")
+template <typename T, typename Allocator, typename... U>
+oneof_reader<
+    T, typename std::allocator_traits<Allocator>::template rebind_alloc<T>>
+oneof(std::allocator_arg_t, Allocator alloc, U&&... vals) {
+    oneof_reader<T, typename std::allocator_traits<
+                        Allocator>::template rebind_alloc<T>>
+        ret(alloc);
+    ret.add(std::forward<U>(vals)...);
+    return ret;
+}
+
+// every string, container and option made while defining or parsing options
+// is obtained from Allocator. The default_value of add<T> is built by the
+// caller, so a string default of an allocator-aware type (e.g.
+// std::pmr::string) should already use get_allocator(); a literal converts
+// through T's default allocator first
+template <typename Allocator = std::allocator<char>>
+class basic_parser {
+    template <typename U>
+    using rebind_t =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+
    public:
-    parser& add(const string_t& name, char short_name = 0,
-                const string_t& description = "") {
-        if (options_.count(name))
-            throw program_options_error("multiple definition: " + name);
-        options_.insert(
-            std::make_pair(name, option_ptr(new option_without_value(
-                                     name, short_name, description))));
-        ordered_.push_back(options_.at(name));
+    using allocator_type = Allocator;
+    using string_type =
+        std::basic_string<char, std::char_traits<char>, rebind_t<char>>;
+    using string_vector = std::vector<string_type, rebind_t<string_type>>;
+
+    basic_parser() : basic_parser(allocator_type()) {}
+
+    explicit basic_parser(const allocator_type& alloc)
+        : alloc_(alloc),
+          options_(alloc),
+          ordered_(alloc),
+          footer_(alloc),
+          program_name_(alloc),
+          others_(alloc),
+          errors_(alloc) {}
+
+    // a copy stays on the same allocator rather than the one
+    // select_on_container_copy_construction picks, since it shares options
+    // allocated from it
+    basic_parser(const basic_parser& other)
+        : alloc_(other.alloc_),
+          options_(other.options_, alloc_),
+          ordered_(other.ordered_, alloc_),
+          footer_(other.footer_, alloc_),
+          program_name_(other.program_name_, alloc_),
+          others_(other.others_, alloc_),
+          errors_(other.errors_, alloc_) {}
+
+    basic_parser(basic_parser&&) = default;
+    basic_parser& operator=(const basic_parser&) = default;
+    basic_parser& operator=(basic_parser&&) = default;
+
+    allocator_type get_allocator() const { return alloc_; }
+
+    basic_parser& add(detail::string_ref name, char short_name = 0,
+                      detail::string_ref description = "") {
+        if (find_option(name))
+            throw program_options_error(
+                detail::concat(string_t(), "multiple definition: ", name));
+        ordered_.push_back(std::allocate_shared<option_without_value>(
+            rebind_t<option_without_value>(alloc_), make_string(name),
+            short_name, make_string(description)));
+        options_.emplace(ordered_.back()->name(), ordered_.back());
         return *this;
     }
 
     template <typename T>
-    parser& add(const string_t& name, char short_name = 0,
-                const string_t& description = "", bool is_required = true,
-                T&& default_value = T()) {
+    basic_parser& add(detail::string_ref name, char short_name = 0,
+                      detail::string_ref description = "",
+                      bool is_required = true, T&& default_value = T()) {
         if (!detail::is_legal_type_v<T>)
-            throw program_options_error("illegal type: " + name);
+            throw program_options_error(
+                detail::concat(string_t(), "illegal type: ", name));
         return add(name, short_name, description, is_required,
                    std::forward<T>(default_value), default_reader<T>());
     }
 
     template <typename T, typename U>
-    parser& add(const string_t& name, char short_name = 0,
-                const string_t& description = "", bool is_required = true,
-                T&& default_value = T(), U&& reader = U()) {
+    basic_parser& add(detail::string_ref name, char short_name = 0,
+                      detail::string_ref description = "",
+                      bool is_required = true, T&& default_value = T(),
+                      U&& reader = U()) {
         if (!detail::is_legal_type_v<T>)
-            throw program_options_error("illegal type: " + name);
-        if (options_.count(name))
-            throw program_options_error("multiple definition: " + name);
-        options_.insert(std::make_pair(
-            name,
-            option_ptr(new option_with_value_with_reader<T, U>(
-                name, short_name, is_required, std::forward<T>(default_value),
-                description, std::forward<U>(reader)))));
-        ordered_.push_back(options_.at(name));
+            throw program_options_error(
+                detail::concat(string_t(), "illegal type: ", name));
+        if (find_option(name))
+            throw program_options_error(
+                detail::concat(string_t(), "multiple definition: ", name));
+        ordered_.push_back(
+            std::allocate_shared<option_with_value_with_reader<T, U>>(
+                rebind_t<option_with_value_with_reader<T, U>>(alloc_),
+                make_string(name), short_name, is_required,
+                std::forward<T>(default_value), make_string(description),
+                std::forward<U>(reader)));
+        options_.emplace(ordered_.back()->name(), ordered_.back());
         return *this;
     };
 
-    void set_footer(const string_t& footer) { footer_ = footer; }
+    void set_footer(detail::string_ref footer) {
+        footer_.assign(footer.data(), footer.size());
+    }
 
-    void set_program_name(const string_t& program_name) {
-        program_name_ = program_name;
+    void set_program_name(detail::string_ref program_name) {
+        program_name_.assign(program_name.data(), program_name.size());
     }
 
-    bool exist(const string_t& name) const {
-        auto iter = options_.find(name);
-        if (iter == options_.end())
-            throw program_options_error("there is no flag: --" + name);
-        return iter->second->has_set();
+    bool exist(detail::string_ref name) const {
+        auto option = find_option(name);
+        if (option == nullptr)
+            throw program_options_error(
+                detail::concat(string_t(), "there is no flag: --", name));
+        return option->has_set();
     }
 
     template <typename T>
-    const T& get(const string_t& name) const {
-        if (options_.count(name) == 0)
-            throw program_options_error("there is no flag: --" + name);
-        auto p = dynamic_cast<const option_with_value<T>*>(
-            options_.find(name)->second.get());
+    const T& get(detail::string_ref name) const {
+        auto option = find_option(name);
+        if (option == nullptr)
+            throw program_options_error(
+                detail::concat(string_t(), "there is no flag: --", name));
+        auto p = dynamic_cast<const option_with_value<T>*>(option);
         if (p == nullptr)
-            throw program_options_error("type mismatch flag '" + name + "'");
+            throw program_options_error(
+                detail::concat(string_t(), "type mismatch flag '", name, "'"));
         return p->get();
     }
 
-    const std::vector<string_t>& rest() const { return others_; }
+    const string_vector& rest() const { return others_; }
 
-    bool parse(const string_t& arg) {
-        std::vector<string_t> args;
-        string_t buf;
+    bool parse(detail::string_ref arg) {
+        string_vector args(alloc_);
+        string_type buf(alloc_);
         bool in_quote{false};
-        for (string_t::size_type i = 0; i != arg.length(); ++i) {
+        for (std::size_t i = 0; i != arg.size(); ++i) {
             if (arg[i] == '\"') {
                 in_quote = !in_quote;
                 continue;
@@ -289,9 +621,9 @@ class parser {
             }
             if (arg[i] == '\\') {
                 ++i;
-                if (i >= arg.length()) {
-                    errors_.emplace_back(
-                        "unexpected occurrence of '\\' at end of string");
+                if (i >= arg.size()) {
+                    errors_.push_back(make_string(
+                        "unexpected occurrence of '\\' at end of string"));
                     return false;
                 }
             }
@@ -299,7 +631,7 @@ class parser {
         }
 
         if (in_quote) {
-            errors_.emplace_back("quote is not closed");
+            errors_.push_back(make_string("quote is not closed"));
             return false;
         }
 
@@ -310,11 +642,11 @@ class parser {
         return parse(args);
     }
 
-    bool parse(const std::vector<string_t>& args) {
+    bool parse(const string_vector& args) {
         auto argc = args.size();
-        std::vector<const char*> argv(argc);
+        std::vector<const char*, rebind_t<const char*>> argv(argc, alloc_);
         std::transform(args.begin(), args.end(), argv.begin(),
-                       [](const string_t& str) { return str.c_str(); });
+                       [](const string_type& str) { return str.c_str(); });
         return parse(argc, argv.data());
     }
 
@@ -323,25 +655,25 @@ class parser {
         others_.clear();
 
         if (argc < 1) {
-            errors_.emplace_back("argument number must be longer than 0");
+            errors_.push_back(
+                make_string("argument number must be longer than 0"));
             return false;
         }
         if (program_name_.empty()) {
             program_name_ = argv[0];
         }
 
-        std::unordered_map<char, string_t> lookup;
+        std::unordered_map<char, string_type, std::hash<char>,
+                           std::equal_to<char>,
+                           rebind_t<std::pair<const char, string_type>>>
+            lookup(alloc_);
         for (auto& item : options_) {
             if (item.first.empty()) continue;
             char short_name{item.second->short_name()};
-            if (short_name) {
-                if (lookup.count(short_name)) {
-                    lookup[short_name].clear();
-                    errors_.push_back(string_t("short option '") + short_name +
-                                      "' is ambiguous");
-                    return false;
-                }
-                lookup[short_name] = item.first;
+            if (short_name && !lookup.emplace(short_name, item.first).second) {
+                errors_.push_back(make_string("short option '", short_name,
+                                              "' is ambiguous"));
+                return false;
             }
         }
 
@@ -349,21 +681,24 @@ class parser {
             if (strncmp(argv[i], "--", 2) == 0) {
                 const char* p{strchr(argv[i] + 2, '=')};
                 if (p) {
-                    string_t name{argv[i] + 2, p};
-                    string_t value{p + 1};
+                    string_type name(argv[i] + 2, p, alloc_);
+                    string_type value(p + 1, alloc_);
                     set_option(name, value);
                 } else {
-                    string_t name{argv[i] + 2};
-                    if (options_.count(name) == 0) {
-                        errors_.push_back("undefined option: --" + name);
+                    string_type name(argv[i] + 2, alloc_);
+                    auto option = options_.find(name);
+                    if (option == options_.end()) {
+                        errors_.push_back(
+                            make_string("undefined option: --", name));
                         continue;
                     }
-                    if (options_[name]->has_value()) {
+                    if (option->second->has_value()) {
                         if (i + 1 >= argc) {
-                            errors_.push_back("option needs value: --" + name);
+                            errors_.push_back(
+                                make_string("option needs value: --", name));
                             continue;
                         } else {
-                            set_option(name, argv[i++]);
+                            set_option(name, make_string(argv[i++]));
                         }
                     } else {
                         set_option(name);
@@ -373,74 +708,85 @@ class parser {
                 if (!argv[i][1]) continue;
                 char last{argv[i][1]};
                 for (int j = 2; argv[i][j]; ++j) {
-                    if (lookup.count(last) == 0) {
+                    auto found = lookup.find(last);
+                    if (found == lookup.end()) {
                         errors_.push_back(
-                            string_t("undefined short option: -") + last);
-                    } else if (lookup[last].empty()) {
+                            make_string("undefined short option: -", last));
+                    } else if (found->second.empty()) {
                         errors_.push_back(
-                            string_t("ambiguous short options: -") + last);
+                            make_string("ambiguous short options: -", last));
                     } else {
-                        set_option(lookup[last]);
+                        set_option(found->second);
                     }
                     last = argv[i][j];
                 }
 
-                if (lookup.count(last) == 0) {
-                    errors_.push_back(string_t("undefined short option: -") +
-                                      last);
+                auto found = lookup.find(last);
+                if (found == lookup.end()) {
+                    errors_.push_back(
+                        make_string("undefined short option: -", last));
                     continue;
-                } else if (lookup[last].empty()) {
-                    errors_.push_back(string_t("ambiguous short options: -") +
-                                      last);
+                } else if (found->second.empty()) {
+                    errors_.push_back(
+                        make_string("ambiguous short options: -", last));
                     continue;
                 }
 
-                if (i + 1 < argc && options_[lookup[last]]->has_value()) {
-                    set_option(lookup[last], argv[++i]);
+                if (i + 1 < argc &&
+                    options_.find(found->second)->second->has_value()) {
+                    set_option(found->second, make_string(argv[++i]));
                 } else {
-                    set_option(lookup[last]);
+                    set_option(found->second);
                 }
             } else {
-                others_.push_back(argv[i]);
+                others_.push_back(make_string(argv[i]));
             }
         }
 
         for (auto& item : options_) {
             if (!item.second->is_valid()) {
-                errors_.push_back("need option: --" + item.first);
+                errors_.push_back(make_string("need option: --", item.first));
             }
         }
 
         return errors_.empty();
     }
 
-    void parse_check(const string_t& arg) {
-        if (!options_.count("help")) add("help", '?', "print this message");
+    void parse_check(detail::string_ref arg) {
+        if (!find_option("help"))
+            add("help", '?', "print this message");
         check(0, parse(arg));
     }
 
-    void parse_check(const std::vector<string_t>& args) {
-        if (!options_.count("help")) add("help", '?', "print this message");
+    void parse_check(const string_vector& args) {
+        if (!find_option("help"))
+            add("help", '?', "print this message");
         check(args.size(), parse(args));
     }
 
     void parse_check(int argc, const char* const argv[]) {
-        if (!options_.count("help")) add("help", '?', "print this message");
+        if (!find_option("help"))
+            add("help", '?', "print this message");
         check(argc, parse(argc, argv));
     }
 
-    string_t error() const { return errors_.empty() ? "" : errors_[0]; }
+    string_type error() const {
+        return errors_.empty() ? string_type(alloc_)
+                               : string_type(errors_[0], alloc_);
+    }
 
-    string_t all_errors() const {
-        std::ostringstream oss;
+    string_type all_errors() const {
+        string_type ret(alloc_);
         for (auto& error : errors_) {
-            oss << error << std::endl;
+            detail::append(ret, error, '\n');
         }
-        return oss.str();
+        return ret;
     }
 
-    string_t usage() const {
-        std::ostringstream oss;
+    string_type usage() const {
+        string_type ret(alloc_);
+        detail::output_buffer<string_type> buf(ret);
+        std::ostream oss(&buf);
         oss << "Usage: " << program_name_ << " ";
         for (auto& item : ordered_) {
             if (item->is_required()) oss << item->short_description() << " ";
@@ -449,7 +795,7 @@ class parser {
         oss << "[options] ... " << footer_ << std::endl;
         oss << "Options:" << std::endl;
 
-        using length_t = decltype(ordered_)::size_type;
+        using length_t = typename option_vector::size_type;
         length_t max_width{(*std::max_element(ordered_.begin(), ordered_.end(),
                                               [](const option_ptr& lhs,
                                                  const option_ptr& rhs) {
@@ -470,10 +816,15 @@ class parser {
                 oss << ' ';
             oss << item->description() << std::endl;
         }
-        return oss.str();
+        return ret;
     }
 
    private:
+    template <typename... Parts>
+    string_type make_string(const Parts&... parts) const {
+        return detail::concat(string_type(alloc_), parts...);
+    }
+
     void check(int argc, bool ok) {
         if ((argc == 1 && !ok) || exist("help")) {
             std::cerr << usage();
@@ -485,25 +836,27 @@ class parser {
         }
     }
 
-    void set_option(const string_t& name) {
-        if (options_.count(name) == 0) {
-            errors_.push_back("undefined options: --" + name);
+    void set_option(const string_type& name) {
+        auto option = options_.find(name);
+        if (option == options_.end()) {
+            errors_.push_back(make_string("undefined options: --", name));
             return;
         }
-        if (!options_[name]->set()) {
-            errors_.push_back("option needs value: --" + name);
+        if (!option->second->set()) {
+            errors_.push_back(make_string("option needs value: --", name));
             return;
         }
     }
 
-    void set_option(const string_t& name, const string_t& value) {
-        if (options_.count(name) == 0) {
-            errors_.push_back("undefined options: --" + name);
+    void set_option(const string_type& name, const string_type& value) {
+        auto option = options_.find(name);
+        if (option == options_.end()) {
+            errors_.push_back(make_string("undefined options: --", name));
             return;
         }
-        if (!options_[name]->set(value)) {
-            errors_.push_back("option value is invalid: --" + name + "=" +
-                              value);
+        if (!option->second->set(value)) {
+            errors_.push_back(make_string("option value is invalid: --", name,
+                                          "=", value));
             return;
         }
     }
@@ -514,66 +867,68 @@ class parser {
 
         virtual bool has_value() const = 0;
         virtual bool set() = 0;
-        virtual bool set(const string_t& value) = 0;
+        virtual bool set(const string_type& value) = 0;
         virtual bool has_set() const = 0;
         virtual bool is_valid() const = 0;
         virtual bool is_required() const = 0;
 
-        virtual const string_t& name() const = 0;
+        virtual const string_type& name() const = 0;
         virtual char short_name() const = 0;
-        virtual const string_t& description() const = 0;
-        virtual string_t short_description() const = 0;
+        virtual const string_type& description() const = 0;
+        virtual string_type short_description() const = 0;
     };
 
     class option_without_value : public option_base {
        public:
-        option_without_value(const string_t& name, char short_name,
-                             const string_t& description)
-            : name_(name),
+        option_without_value(string_type name, char short_name,
+                             string_type description)
+            : name_(std::move(name)),
               short_name_(short_name),
-              description_(description),
+              description_(std::move(description)),
               has_set_(false) {}
 
         virtual bool has_value() const override { return false; }
         virtual bool set() override { return (has_set_ = true); }
-        virtual bool set(const string_t&) override { return false; }
+        virtual bool set(const string_type&) override { return false; }
         virtual bool has_set() const override { return has_set_; }
         virtual bool is_valid() const override { return true; }
         virtual bool is_required() const override { return false; }
-        virtual const string_t& name() const override { return name_; }
+        virtual const string_type& name() const override { return name_; }
         virtual char short_name() const override { return short_name_; }
-        virtual const string_t& description() const override {
+        virtual const string_type& description() const override {
             return description_;
         }
-        virtual string_t short_description() const override {
-            return "--" + name_;
+        virtual string_type short_description() const override {
+            return detail::concat(string_type(name_.get_allocator()), "--",
+                                  name_);
         }
 
        private:
-        string_t name_;
+        string_type name_;
         char short_name_;
-        string_t description_;
+        string_type description_;
         bool has_set_;
     };
 
     template <typename T>
     class option_with_value : public option_base {
        public:
-        option_with_value(const string_t& name, char short_name,
-                          bool is_required, const T& default_value,
-                          const string_t& description)
-            : name_(name),
+        option_with_value(string_type name, char short_name, bool is_required,
+                          const T& default_value, string_type description)
+            : name_(std::move(name)),
               short_name_(short_name),
               is_required_(is_required),
               has_set_(false),
-              default_value_(default_value),
-              actual_value_(default_value),
-              description_(full_description(description)) {}
+              default_value_(
+                  detail::make_value<T>(default_value, name_.get_allocator())),
+              actual_value_(
+                  detail::make_value<T>(default_value, name_.get_allocator())),
+              description_(full_description(std::move(description))) {}
 
         const T& get() const { return actual_value_; }
         virtual bool has_value() const override { return true; }
         virtual bool set() override { return false; }
-        virtual bool set(const string_t& value) override {
+        virtual bool set(const string_type& value) override {
             try {
                 actual_value_ = read(value);
             } catch (const std::exception&) {
@@ -586,56 +941,85 @@ class parser {
             return (!is_required_) || has_set_;
         }
         virtual bool is_required() const override { return is_required_; }
-        virtual const string_t& name() const override { return name_; }
+        virtual const string_type& name() const override { return name_; }
         virtual char short_name() const override { return short_name_; }
-        virtual const string_t& description() const override {
+        virtual const string_type& description() const override {
             return description_;
         }
-        virtual string_t short_description() const override {
-            return "--" + name_ + "=" + detail::type_name<T>();
+        virtual string_type short_description() const override {
+            return detail::concat(string_type(name_.get_allocator()), "--",
+                                  name_, "=", detail::type_name<T>());
         }
 
        protected:
-        string_t full_description(const string_t& description) {
-            return description + " (" + detail::type_name<T>() +
-                   (is_required_
-                        ? ""
-                        : (" [=" + detail::as_string(default_value_) + "]")) +
-                   ")";
+        string_type full_description(string_type description) {
+            detail::append(description, " (", detail::type_name<T>());
+            if (!is_required_) {
+                detail::append(description, " [=");
+                detail::append_as_string(description, default_value_);
+                detail::append(description, "]");
+            }
+            detail::append(description, ")");
+            return description;
         }
 
-        virtual T read(const string_t& str) = 0;
-        string_t name_;
+        virtual T read(const string_type& str) = 0;
+        string_type name_;
         char short_name_;
         bool is_required_;
         bool has_set_;
         T default_value_;
         T actual_value_;
-        string_t description_;
+        string_type description_;
     };
 
     template <typename T, typename U>
     class option_with_value_with_reader : public option_with_value<T> {
        public:
-        option_with_value_with_reader(const string_t& name, char short_name,
+        option_with_value_with_reader(string_type name, char short_name,
                                       bool is_required, const T& default_value,
-                                      const string_t& description, U&& reader)
-            : option_with_value<T>(name, short_name, is_required, default_value,
-                                   description),
+                                      string_type description, U&& reader)
+            : option_with_value<T>(std::move(name), short_name, is_required,
+                                   default_value, std::move(description)),
               reader_(std::forward<U>(reader)) {}
 
        private:
-        T read(const string_t& str) { return reader_(str); }
+        T read(const string_type& str) { return reader_(str); }
 
         U reader_;
     };
 
+    // lookups by name scan ordered_ instead of building a key, so repeated
+    // get/exist calls take no memory from the allocator
+    const option_base* find_option(detail::string_ref name) const {
+        for (auto& item : ordered_) {
+            if (detail::equal(item->name(), name)) return item.get();
+        }
+        return nullptr;
+    }
+
     using option_ptr = std::shared_ptr<option_base>;
-    std::unordered_map<string_t, option_ptr> options_;
-    std::vector<option_ptr> ordered_;
-    string_t footer_;
-    string_t program_name_;
-    std::vector<string_t> others_;
-    std::vector<string_t> errors_;
+    using option_map =
+        std::unordered_map<string_type, option_ptr, detail::string_hash,
+                           std::equal_to<string_type>,
+                           rebind_t<std::pair<const string_type, option_ptr>>>;
+    using option_vector = std::vector<option_ptr, rebind_t<option_ptr>>;
+    allocator_type alloc_;
+    option_map options_;
+    option_vector ordered_;
+    string_type footer_;
+    string_type program_name_;
+    string_vector others_;
+    string_vector errors_;
 };
+
+using parser = basic_parser<>;
+
+#ifdef PROGRAM_OPTIONS_HAS_PMR
+namespace pmr {
+// parser whose allocations all come from a std::pmr::memory_resource, e.g.
+// a monotonic_buffer_resource released once the parse is done
+using parser = basic_parser<std::pmr::polymorphic_allocator<char>>;
+}  // namespace pmr
+#endif
 }  // namespace program_options